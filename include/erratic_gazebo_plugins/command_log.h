@@ -0,0 +1,113 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef COMMAND_LOG_HH
+#define COMMAND_LOG_HH
+
+#include <map>
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace gazebo
+{
+
+class MappedFile;
+
+// Recorded velocity commands for many robots, memory-mapped and shared by all
+// the plugins in the process. The file is laid out in host byte order as
+//
+//   Header       magic "DDCMDLG1", robot count, reserved
+//   RobotEntry   one per robot: id, index of its first record, record count
+//   Record       sorted by time within each robot
+//
+// Loading throws if a robot is listed twice or its records are out of order.
+class CommandLog : private boost::noncopyable
+{
+  public: struct Header
+  {
+    char magic[8];
+    boost::uint32_t robot_count;
+    boost::uint32_t reserved;
+  };
+
+  public: struct RobotEntry
+  {
+    char id[64];
+    boost::uint64_t first;
+    boost::uint64_t count;
+  };
+
+  public: struct Record
+  {
+    double time;
+    double linear;
+    double angular;
+  };
+
+  // The commands of a single robot.
+  public: struct Track
+  {
+    Record const *begin;
+    Record const *end;
+  };
+
+  public: static boost::shared_ptr<CommandLog const> Get(std::string const &_path);
+
+  // Returns false if the log has no commands for the robot.
+  public: bool Find(std::string const &_id, Track &_track) const;
+
+  public: ~CommandLog();
+  private: explicit CommandLog(std::string const &_path);
+
+private:
+  boost::scoped_ptr<MappedFile> file_;
+  std::map<std::string, Track> tracks_;
+};
+
+// Replays a track by simulation time, holding each command until the next.
+class CommandCursor
+{
+  public: CommandCursor();
+  public: explicit CommandCursor(CommandLog::Track const &_track);
+
+  // Returns false before the first command.
+  public: bool Get(double _time, double &_linear, double &_angular);
+
+private:
+  CommandLog::Track track_;
+  CommandLog::Record const *next_;
+};
+
+}
+
+#endif
+
+/* vim: set ts=2 sts=2 sw=2: */
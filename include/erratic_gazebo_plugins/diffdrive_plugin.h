@@ -29,6 +29,7 @@
 #define DIFFDRIVE_PLUGIN_HH
 
 #include <map>
+#include <set>
 
 #include <gazebo.h>
 #include <common/common.h>
@@ -46,16 +47,26 @@
 #include <tf/transform_listener.h>
 #include <geometry_msgs/Twist.h>
 #include <nav_msgs/Odometry.h>
+#include <erratic_gazebo_plugins/Odometry2D.h>
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
 #include <ros/advertise_options.h>
 
+#include <erratic_gazebo_plugins/command_log.h>
+#include <erratic_gazebo_plugins/path_logger.h>
+#include <erratic_gazebo_plugins/world_snapshot.h>
+
 // Boost
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/normal_distribution.hpp>
+#include <boost/random/taus88.hpp>
 #include <boost/random/variate_generator.hpp>
 
 namespace gazebo
@@ -71,10 +82,54 @@ class DiffDrivePlugin : public ModelPlugin
   protected: virtual void UpdateChild();
   protected: virtual void FiniChild();
 
+  // Odometry state that is needed to continue a simulation from a given step.
+  public: struct Snapshot
+  {
+    double odomPose[3];
+    double odomVel[3];
+    ros::Time last_time;
+    double last_true_yaw, last_odom_yaw;
+    btVector3 last_true_pos, last_odom_pos;
+    double x, rot;
+    std::string rng;
+  };
+
+  public: Snapshot GetSnapshot();
+  public: void RestoreSnapshot(Snapshot const &snapshot);
+
+  // Branching a running simulation into forked rollouts. fork() copies only
+  // the calling thread, so the caller brackets its own fork() with these
+  // calls on the physics thread, e.g. from a world update callback:
+  //
+  //   DiffDrivePlugin::PrepareBranch();
+  //   if (fork() == 0) DiffDrivePlugin::Branch(id);
+  //   else             DiffDrivePlugin::ResumeAfterBranch();
+  //
+  // roscpp cannot be restarted after fork(), so a branch does no ROS I/O: it
+  // ignores cmd_vel, publishes and logs nothing, and samples on simulation
+  // time. Each instance reseeds its noise from the branch id and continues
+  // its path log in "<pathLog>.branch_<id>"; the host drives variants with
+  // SetCommand() and reads results with GetSnapshot(). A branch ends with
+  // FinishBranch(), which writes out the path logs, and then _exit(), so
+  // that the ROS handles inherited from the parent are never torn down.
+  public: static void PrepareBranch();
+  public: static void Branch(unsigned int branch);
+  public: static void ResumeAfterBranch();
+  public: static void FinishBranch();
+  public: void SetCommand(double linear, double angular);
+
+  // Shallow size in bytes of each per-instance component; a shared
+  // broadcaster is divided between the instances that use it. Members held
+  // by value, such as the callback queue, are part of "plugin".
+  public: std::map<std::string, size_t> GetMemoryFootprint() const;
+  // Virtual stack size of each thread, reported apart from the footprint.
+  public: std::map<std::string, size_t> GetStackReservation() const;
+  public: void ReportMemoryFootprint() const;
+
 private:
   typedef boost::mt19937 RNGType;
+  typedef boost::taus88 CompactRNGType;
   typedef boost::normal_distribution<> normal_dist;
-  typedef boost::variate_generator<RNGType &, normal_dist> normal_gen;
 
   struct OdometryUpdate {
     btVector3 curr_odom_pos;
@@ -82,8 +137,19 @@ private:
     double v_left, v_right;
   };
 
+  void ConnectRos(std::string const &ns);
+
+  // Everything the odometry outputs need from a single physics step.
+  struct OdometrySample {
+    ros::Time time;
+    WorldSnapshot::Entry state;
+    int degrade_level;
+  };
+
+  void UpdateDrive();
   void write_position_data();
   void publish_odometry();
+  void process_odometry(OdometrySample const &sample);
   void GetPositionCmd();
 
   physics::WorldPtr world;
@@ -104,20 +170,34 @@ private:
 
   physics::JointPtr joints[2];
   physics::PhysicsEnginePtr physicsEngine;
+  boost::shared_ptr<WorldSnapshot> world_snapshot_;
+  size_t world_snapshot_slot_;
 
   // Odometry Noise
-  ros::Time last_time_;
+  ros::Time last_time_, last_sample_time_;
   double rate_;
-  boost::mt19937 rng_;
+  // Only one of the generators is used: rng_ unless <compactRng> is set.
+  boost::scoped_ptr<RNGType> rng_;
+  CompactRNGType compact_rng_;
+  boost::uint32_t seed_;
+  void SeedNoise(boost::uint32_t seed);
+  double SampleNoise(normal_dist const &dist);
   double last_true_yaw_, last_odom_yaw_;
   btVector3 last_true_pos_, last_odom_pos_;
 
+  // Path logging
+  std::string path_log_;
+  boost::scoped_ptr<PathLogger> path_logger_;
+
   // ROS STUFF
   ros::NodeHandle* rosnode_;
-  ros::Publisher pub_odom_, pub_wheel_;
+  ros::Publisher pub_odom_, pub_wheel_, pub_diagnostics_;
   ros::Subscriber sub_;
-  tf::TransformBroadcaster *transform_broadcaster_;
+  boost::shared_ptr<tf::TransformBroadcaster> transform_broadcaster_;
+  bool shared_broadcaster_;
+  static boost::weak_ptr<tf::TransformBroadcaster> shared_transform_broadcaster_;
   std::string tf_prefix_, tf_base_frame_, tf_odom_frame_;
+  bool compact_odom_;
 
   boost::mutex lock;
 
@@ -127,8 +207,44 @@ private:
   // Custom Callback Queue
   ros::CallbackQueue queue_;
   boost::thread callback_queue_thread_;
+  size_t thread_stack_size_;
+  void StartThread(boost::thread &thread, void (DiffDrivePlugin::*body)());
+  void StartQueueThread();
   void QueueThread();
 
+  // Pipelined odometry
+  bool pipelined_;
+  bool pipeline_running_;
+  bool pipeline_full_;
+  OdometrySample pipeline_sample_;
+  boost::mutex pipeline_lock_;
+  boost::condition_variable pipeline_cond_;
+  boost::thread pipeline_thread_;
+  void StartPipelineThread();
+  void StopPipelineThread();
+  void WaitForPipeline();
+  void PipelineThread();
+
+  // CPU budget
+  double cpu_budget_;
+  double cpu_update_;
+  double cpu_threads_;
+  double budget_window_start_;
+  int degrade_level_;
+  boost::mutex budget_lock_;
+  void AddThreadTime(double seconds);
+  void CheckBudget();
+  void PublishBudget(double elapsed, double cpu_threads, double usage);
+
+  // Branching
+  bool queue_paused_;
+  bool pipeline_paused_;
+  bool branched_;
+  void BranchChild(unsigned int branch);
+  ros::Time Now() const;
+  static boost::mutex instances_lock_;
+  static std::set<DiffDrivePlugin *> instances_;
+
   // DiffDrive stuff
   OdometryUpdate generateError(btVector3 const &curr_true_pose, double curr_true_yaw);
   void cmdVelCallback(const geometry_msgs::Twist::ConstPtr& cmd_msg);
@@ -136,6 +252,14 @@ private:
   double x_;
   double rot_;
   bool alive_;
+
+  // Recorded commands
+  boost::shared_ptr<CommandLog const> command_log_;
+  CommandCursor command_cursor_;
+
+  // Sleeping
+  bool allow_sleep_;
+  bool asleep_;
 };
 
 }
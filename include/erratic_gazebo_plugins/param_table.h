@@ -0,0 +1,74 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PARAM_TABLE_HH
+#define PARAM_TABLE_HH
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace gazebo
+{
+
+// Plugin parameters for a whole fleet, read from a CSV file with one row per
+// model. The first line names the columns; the first column holds the model
+// name and the others are named after the plugin's SDF elements, e.g.
+//
+//   model,wheelSeparation,wheelDiameter,torque,alpha,seed,updateRate
+//   erratic_1,0.34,0.15,5.0,0.1,1,50
+//
+// Blank lines and lines starting with '#' are ignored. Each model may have
+// only one row.
+class ParamTable : private boost::noncopyable
+{
+  public: typedef std::map<std::string, std::string> Row;
+
+  // Each file is mapped and parsed once per process and then shared.
+  public: static boost::shared_ptr<ParamTable const> Get(std::string const &_path);
+
+  // Returns NULL if the table has no row for the model.
+  public: Row const *Find(std::string const &_model) const;
+
+  // Names of the parameter columns, i.e. all but the model name.
+  public: std::vector<std::string> const &GetColumns() const { return columns_; }
+
+  private: explicit ParamTable(std::string const &_path);
+
+private:
+  std::vector<std::string> columns_;
+  std::map<std::string, Row> rows_;
+};
+
+}
+
+#endif
+
+/* vim: set ts=2 sts=2 sw=2: */
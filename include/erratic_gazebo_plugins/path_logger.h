@@ -0,0 +1,106 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PATH_LOGGER_HH
+#define PATH_LOGGER_HH
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace gazebo
+{
+
+struct PathVertex
+{
+  double t;
+  double x, y, yaw;
+};
+
+// Online simplification of a planar path. Every dropped sample lies within
+// the tolerance of the segment between the two retained vertices around it.
+// A new segment is started whenever the next sample would violate that bound
+// or the window of pending samples is full, so each sample costs at most
+// O(window) work.
+class PathSimplifier
+{
+  public: PathSimplifier(double _tolerance, size_t _window);
+
+  // Returns true and sets _vertex when a vertex is retained.
+  public: bool Add(PathVertex const &_sample, PathVertex &_vertex);
+
+  // Retains the last pending sample, if any, to close the path.
+  public: bool Flush(PathVertex &_vertex);
+
+  public: bool GetAnchor(PathVertex &_vertex) const;
+
+  // Heap bytes held for pending samples once the window has filled.
+  public: size_t GetMemoryFootprint() const;
+
+private:
+  double tolerance_;
+  size_t window_;
+  bool started_;
+  PathVertex anchor_;
+  std::vector<PathVertex> pending_;
+};
+
+// Writes the simplified odometry and ground truth paths of one robot as lines
+// of "<odom|true> <time> <x> <y> <yaw>".
+class PathLogger : private boost::noncopyable
+{
+  public: PathLogger(std::string const &_path, double _tolerance, size_t _window);
+  public: ~PathLogger();
+
+  public: void Log(PathVertex const &_odom, PathVertex const &_truth);
+
+  // Flushes buffered output, e.g. before fork() duplicates the buffer.
+  public: void Sync();
+
+  // Bytes held by the logger, its file buffer and both simplifiers.
+  public: size_t GetMemoryFootprint() const;
+
+  // Writes the pending ends of both paths and closes the file.
+  public: void Close();
+
+  // Continues the paths in a new file, starting from the last retained vertices.
+  public: void Reopen(std::string const &_path);
+
+private:
+  void Write(char const *_tag, PathVertex const &_vertex);
+
+  std::ofstream file_;
+  PathSimplifier odom_, truth_;
+};
+
+}
+
+#endif
+
+/* vim: set ts=2 sts=2 sw=2: */
@@ -0,0 +1,85 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WORLD_SNAPSHOT_HH
+#define WORLD_SNAPSHOT_HH
+
+#include <vector>
+
+#include <common/Time.hh>
+#include <math/Pose.hh>
+#include <math/Vector3.hh>
+#include <physics/PhysicsTypes.hh>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace gazebo
+{
+
+// Poses and velocities of every registered model, read from the world once
+// per simulation step and shared by all the plugins in the world. Plugins
+// register their model once and then read their slot by index.
+class WorldSnapshot : private boost::noncopyable
+{
+  public: struct Entry
+  {
+    math::Pose pose;
+    math::Vector3 linear_vel;
+    math::Vector3 angular_vel;
+  };
+
+  public: static boost::shared_ptr<WorldSnapshot> Get(physics::WorldPtr _world);
+
+  public: size_t Register(physics::ModelPtr _model);
+  public: void Unregister(size_t _slot);
+
+  // The first read in a new simulation step refreshes every slot.
+  public: Entry Read(size_t _slot);
+
+  // Records a pose set on the model during this step, so later reads in the
+  // same step see it instead of the pose from before the step.
+  public: void SetPose(size_t _slot, math::Pose const &_pose);
+
+  private: explicit WorldSnapshot(physics::WorldPtr _world);
+  private: void Refresh();
+
+private:
+  physics::WorldPtr world_;
+  common::Time stamp_;
+  bool valid_;
+  std::vector<physics::ModelPtr> models_;
+  std::vector<Entry> entries_;
+  boost::mutex mutex_;
+};
+
+}
+
+#endif
+
+/* vim: set ts=2 sts=2 sw=2: */
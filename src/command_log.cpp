@@ -0,0 +1,172 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <erratic_gazebo_plugins/command_log.h>
+#include <erratic_gazebo_plugins/mapped_file.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <gazebo.h>
+#include <common/Exception.hh>
+
+#include <boost/thread/mutex.hpp>
+
+namespace gazebo
+{
+
+static char const command_log_magic[8] = { 'D', 'D', 'C', 'M', 'D', 'L', 'G', '1' };
+
+static bool record_before(double time, CommandLog::Record const &record)
+{
+  return time < record.time;
+}
+
+boost::shared_ptr<CommandLog const> CommandLog::Get(std::string const &_path)
+{
+  typedef std::map<std::string, boost::shared_ptr<CommandLog const> > LogMap;
+  static boost::mutex mutex;
+  static LogMap logs;
+
+  boost::mutex::scoped_lock guard(mutex);
+
+  LogMap::const_iterator const it = logs.find(_path);
+  if (it != logs.end())
+  {
+    return it->second;
+  }
+
+  boost::shared_ptr<CommandLog const> const log(new CommandLog(_path));
+  logs[_path] = log;
+  return log;
+}
+
+bool CommandLog::Find(std::string const &_id, Track &_track) const
+{
+  std::map<std::string, Track>::const_iterator const it = tracks_.find(_id);
+  if (it == tracks_.end()) return false;
+
+  _track = it->second;
+  return true;
+}
+
+CommandLog::~CommandLog()
+{
+}
+
+CommandLog::CommandLog(std::string const &_path)
+  : file_(new MappedFile(_path))
+{
+  char const *const data = file_->GetData();
+  size_t const size = file_->GetSize();
+
+  if (size < sizeof(Header) || memcmp(data, command_log_magic, sizeof(command_log_magic)))
+  {
+    gzthrow(_path << " is not a command log");
+  }
+
+  Header const *const header = reinterpret_cast<Header const *>(data);
+  size_t const records_offset = sizeof(Header) + header->robot_count * sizeof(RobotEntry);
+  if (size < records_offset || (size - records_offset) % sizeof(Record))
+  {
+    gzthrow(_path << " is truncated");
+  }
+
+  RobotEntry const *const robots = reinterpret_cast<RobotEntry const *>(data + sizeof(Header));
+  Record const *const records = reinterpret_cast<Record const *>(data + records_offset);
+  size_t const record_count = (size - records_offset) / sizeof(Record);
+
+  for (boost::uint32_t i = 0; i < header->robot_count; ++i)
+  {
+    RobotEntry const &robot = robots[i];
+    std::string const id(robot.id, strnlen(robot.id, sizeof(robot.id)));
+    if (robot.first > record_count || robot.count > record_count - robot.first)
+    {
+      gzthrow(_path << ": commands for " << id << " are out of range");
+    }
+
+    if (tracks_.count(id))
+    {
+      gzthrow(_path << " lists " << id << " more than once");
+    }
+
+    // CommandCursor searches each track by time.
+    Track &track = tracks_[id];
+    track.begin = records + robot.first;
+    track.end = track.begin + robot.count;
+    for (boost::uint64_t j = 1; j < robot.count; ++j)
+    {
+      if (!(track.begin[j - 1].time <= track.begin[j].time))
+      {
+        gzthrow(_path << ": commands for " << id << " are not sorted by time at record "
+                << robot.first + j);
+      }
+    }
+  }
+}
+
+CommandCursor::CommandCursor()
+  : next_(NULL)
+{
+  track_.begin = NULL;
+  track_.end = NULL;
+}
+
+CommandCursor::CommandCursor(CommandLog::Track const &_track)
+  : track_(_track)
+  , next_(_track.begin)
+{
+}
+
+bool CommandCursor::Get(double _time, double &_linear, double &_angular)
+{
+  // Simulation time normally only moves forward by a step, so start the search
+  // from the previous position; a reset of the world starts it over.
+  CommandLog::Record const *from = next_;
+  if (next_ != track_.begin && _time < next_[-1].time)
+  {
+    from = track_.begin;
+  }
+  if (from != track_.end && from->time <= _time)
+  {
+    next_ = std::upper_bound(from, track_.end, _time, record_before);
+  }
+  else
+  {
+    next_ = from;
+  }
+
+  if (next_ == track_.begin) return false;
+
+  _linear = next_[-1].linear;
+  _angular = next_[-1].angular;
+  return true;
+}
+
+}
+
+/* vim: set ts=2 sts=2 sw=2: */
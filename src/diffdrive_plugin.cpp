@@ -28,8 +28,14 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <pthread.h>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <time.h>
 
 #include <erratic_gazebo_plugins/diffdrive_plugin.h>
+#include <erratic_gazebo_plugins/param_table.h>
 
 #include <gazebo.h>
 #include <common/Exception.hh>
@@ -48,14 +54,128 @@
 #include <tf/transform_listener.h>
 #include <geometry_msgs/Twist.h>
 #include <nav_msgs/Odometry.h>
+#include <erratic_gazebo_plugins/Odometry2D.h>
 #include <robot_kf/WheelOdometry.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <boost/algorithm/string/trim.hpp>
 #include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/version.hpp>
 
 static double const min_variance = 1e-6;
+static double const rest_velocity = 1e-3;
+static size_t const path_log_window = 32;
+static double const budget_window = 1.0;
+static int const max_degrade_level = 5;
 
 namespace gazebo
 {
 
+static double thread_cpu_time()
+{
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+template <class Engine>
+static double sample(Engine &rng, boost::normal_distribution<> const &dist)
+{
+  boost::variate_generator<Engine &, boost::normal_distribution<> > gen(rng, dist);
+  return gen();
+}
+
+// Every parameter that may be given in a fleet table.
+static char const *const table_params[] = {
+  "robotNamespace", "leftJoint", "rightJoint", "wheelSeparation", "wheelDiameter",
+  "torque", "twistTopicName", "odomTopicName", "wheelTopicName", "baseFrame",
+  "odomFrame", "alpha", "updateRate", "seed", "pathLog", "pathLogTolerance",
+  "pathLogWindow", "cpuBudget", "commandLog", "commandLogId", "compactOdometry",
+  "allowSleep", "pipelined", "compactRng", "sharedTransformBroadcaster",
+  "threadStackSize", "reportMemory",
+};
+
+static boost::uint32_t parse_unsigned(std::string const &name, std::string const &value)
+{
+  std::string const digits = boost::algorithm::trim_copy(value);
+  if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos
+      || digits.size() > 10 || strtoull(digits.c_str(), NULL, 10) > 0xffffffffull)
+  {
+    gzthrow("Differential Drive plugin expected an unsigned 32-bit integer for <" << name << ">, got " << value);
+  }
+  return static_cast<boost::uint32_t>(strtoull(digits.c_str(), NULL, 10));
+}
+
+static bool parse_bool(std::string const &name, std::string const &value)
+{
+  std::string const word = boost::algorithm::trim_copy(value);
+  if (word == "true" || word == "1") return true;
+  if (word == "false" || word == "0") return false;
+  gzthrow("Differential Drive plugin expected true or false for <" << name << ">, got " << value);
+}
+
+static double parse_double(std::string const &name, std::string const &value)
+{
+  try
+  {
+    return boost::lexical_cast<double>(value);
+  }
+  catch (boost::bad_lexical_cast const &)
+  {
+    gzthrow("Differential Drive plugin expected a number for <" << name << ">, got " << value);
+  }
+}
+
+static bool find_param(sdf::ElementPtr sdf, ParamTable::Row const *row,
+                       std::string const &name, std::string &value)
+{
+  if (row)
+  {
+    ParamTable::Row::const_iterator const it = row->find(name);
+    if (it != row->end())
+    {
+      value = it->second;
+      return true;
+    }
+  }
+
+  if (sdf->HasElement(name))
+  {
+    value = sdf->GetElement(name)->GetValueString();
+    return true;
+  }
+  return false;
+}
+
+// Optional switches are off unless given.
+static bool get_flag(sdf::ElementPtr sdf, ParamTable::Row const *row, std::string const &name)
+{
+  std::string value;
+  return find_param(sdf, row, name, value) && parse_bool(name, value);
+}
+
+static std::string get_param(sdf::ElementPtr sdf, ParamTable::Row const *row,
+                             std::string const &name, std::string const &fallback)
+{
+  std::string value;
+  if (find_param(sdf, row, name, value)) return value;
+
+  ROS_WARN("Differential Drive plugin missing <%s>, defaults to %s", name.c_str(), fallback.c_str());
+  return fallback;
+}
+
+static double get_param(sdf::ElementPtr sdf, ParamTable::Row const *row,
+                        std::string const &name, double fallback)
+{
+  std::string value;
+  if (find_param(sdf, row, name, value)) return parse_double(name, value);
+
+  ROS_WARN("Differential Drive plugin missing <%s>, defaults to %g", name.c_str(), fallback);
+  return fallback;
+}
+
 enum
 {
   RIGHT,
@@ -64,18 +184,48 @@ enum
 
 // Constructor
 DiffDrivePlugin::DiffDrivePlugin(void)
-  : last_true_yaw_(0)
+  : rng_(new RNGType())
+  , seed_(5489u) // boost::mt19937's default seed
+  , last_true_yaw_(0)
   , last_odom_yaw_(0)
   , last_true_pos_(0, 0, 0)
   , last_odom_pos_(0, 0, 0)
+  , rosnode_(NULL)
+  , shared_broadcaster_(false)
+  , thread_stack_size_(0)
+  , pipelined_(false)
+  , pipeline_running_(false)
+  , pipeline_full_(false)
+  , cpu_budget_(0.0)
+  , cpu_update_(0.0)
+  , cpu_threads_(0.0)
+  , budget_window_start_(-1.0)
+  , degrade_level_(0)
+  , queue_paused_(false)
+  , pipeline_paused_(false)
+  , branched_(false)
 {
 }
 
 // Destructor
 DiffDrivePlugin::~DiffDrivePlugin()
 {
+  {
+    boost::mutex::scoped_lock guard(instances_lock_);
+    instances_.erase(this);
+  }
+
+  // Gazebo never calls FiniChild(), so the worker threads are stopped here
+  // before the members they use are destroyed.
+  StopPipelineThread();
+  alive_ = false;
+  if (callback_queue_thread_.joinable()) callback_queue_thread_.join();
+
+  if (world_snapshot_)
+  {
+    world_snapshot_->Unregister(world_snapshot_slot_);
+  }
   delete rosnode_;
-  delete transform_broadcaster_;
 }
 
 // Load the controller
@@ -88,130 +238,141 @@ void DiffDrivePlugin::Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
 
   if (!this->parent) { gzthrow("Differential_Position2d controller requires a Model as its parent"); }
 
-  this->robotNamespace = "";
-  if (_sdf->HasElement("robotNamespace"))
+  // Parameters found in the shared fleet table take precedence over the SDF.
+  boost::shared_ptr<ParamTable const> table;
+  ParamTable::Row const *row = NULL;
+  if (_sdf->HasElement("paramTable"))
   {
-    this->robotNamespace = _sdf->GetElement("robotNamespace")->GetValueString() + "/";
+    std::string const path = _sdf->GetElement("paramTable")->GetValueString();
+    table = ParamTable::Get(path);
+
+    // A misspelled column would otherwise silently fall back to the SDF.
+    std::vector<std::string> const &columns = table->GetColumns();
+    char const *const *const params_end = table_params + sizeof(table_params) / sizeof(table_params[0]);
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+      if (std::find(table_params, params_end, columns[i]) == params_end)
+      {
+        gzthrow(path << " has an unknown column " << columns[i]);
+      }
+    }
+
+    row = table->Find(this->parent->GetName());
+    if (!row)
+    {
+      ROS_WARN("Differential Drive plugin found no row for %s in %s, using the SDF",
+               this->parent->GetName().c_str(), path.c_str());
+    }
   }
 
-  if (!_sdf->HasElement("leftJoint"))
-  {
-    ROS_WARN("Differential Drive plugin missing <leftJoint>, defaults to left_joint");
-    this->leftJointName = "left_joint";
-  }
-  else
+  std::string ns;
+  this->robotNamespace = "";
+  if (find_param(_sdf, row, "robotNamespace", ns))
   {
-    this->leftJointName = _sdf->GetElement("leftJoint")->GetValueString();
+    this->robotNamespace = ns + "/";
   }
 
-  if (!_sdf->HasElement("rightJoint"))
-  {
-    ROS_WARN("Differential Drive plugin missing <rightJoint>, defaults to right_joint");
-    this->rightJointName = "right_joint";
-  }
-  else
+  this->leftJointName = get_param(_sdf, row, "leftJoint", "left_joint");
+  this->rightJointName = get_param(_sdf, row, "rightJoint", "right_joint");
+  this->wheelSeparation = get_param(_sdf, row, "wheelSeparation", 0.34);
+  this->wheelDiameter = get_param(_sdf, row, "wheelDiameter", 0.15);
+  this->torque = get_param(_sdf, row, "torque", 5.0);
+  this->twistTopicName = get_param(_sdf, row, "twistTopicName", "cmd_vel");
+  this->odomTopicName = get_param(_sdf, row, "odomTopicName", "odom");
+  this->wheelOdomTopicName = get_param(_sdf, row, "wheelTopicName", "wheel_odom");
+  this->tf_base_frame_ = get_param(_sdf, row, "baseFrame", "base_footprint");
+  this->tf_odom_frame_ = get_param(_sdf, row, "odomFrame", "odom");
+  this->alpha = get_param(_sdf, row, "alpha", 0.0);
+  rate_ = get_param(_sdf, row, "updateRate", 50.0);
+
+  // Memory footprint
+  if (get_flag(_sdf, row, "compactRng"))
   {
-    this->rightJointName = _sdf->GetElement("rightJoint")->GetValueString();
+    rng_.reset();
   }
 
-  if (!_sdf->HasElement("wheelSeparation"))
-  {
-    ROS_WARN("Differential Drive plugin missing <wheelSeparation>, defaults to 0.34");
-    this->wheelSeparation = 0.34;
-  }
-  else
-  {
-    this->wheelSeparation = _sdf->GetElement("wheelSeparation")->GetValueDouble();
-  }
+  this->shared_broadcaster_ = get_flag(_sdf, row, "sharedTransformBroadcaster");
 
-  if (!_sdf->HasElement("wheelDiameter"))
-  {
-    ROS_WARN("Differential Drive plugin missing <wheelDiameter>, defaults to 0.15");
-    this->wheelDiameter = 0.15;
-  }
-  else
+  std::string stack_size;
+  if (find_param(_sdf, row, "threadStackSize", stack_size))
   {
-    this->wheelDiameter = _sdf->GetElement("wheelDiameter")->GetValueDouble();
+    this->thread_stack_size_ = parse_unsigned("threadStackSize", stack_size);
+#if BOOST_VERSION < 105000
+    ROS_WARN("Differential Drive plugin ignores <threadStackSize>, it needs Boost 1.50 or newer");
+#endif
   }
 
-  if (!_sdf->HasElement("torque"))
+  // Keep the generator's default seed unless one is given.
+  std::string seed;
+  if (find_param(_sdf, row, "seed", seed))
   {
-    ROS_WARN("Differential Drive plugin missing <torque>, defaults to 5.0");
-    this->torque = 5.0;
-  }
-  else {
-    this->torque = _sdf->GetElement("torque")->GetValueDouble();
+    seed_ = parse_unsigned("seed", seed);
   }
+  SeedNoise(seed_);
 
-  if (!_sdf->HasElement("twistTopicName"))
+  // Simplified odometry and ground truth paths, within pathLogTolerance meters.
+  // Each sample re-checks up to pathLogWindow pending samples.
+  if (find_param(_sdf, row, "pathLog", path_log_))
   {
-    ROS_WARN("Differential Drive plugin missing <twistTopicName>, defaults to cmd_vel");
-    this->twistTopicName = "cmd_vel";
-  }
-  else
-  {
-    this->twistTopicName = _sdf->GetElement("twistTopicName")->GetValueString();
+    std::string tolerance = "0.01";
+    find_param(_sdf, row, "pathLogTolerance", tolerance);
+    size_t window = path_log_window;
+    std::string value;
+    if (find_param(_sdf, row, "pathLogWindow", value))
+    {
+      double const parsed = parse_double("pathLogWindow", value);
+      if (!(parsed >= 1 && parsed <= 65536) || parsed != std::floor(parsed))
+      {
+        gzthrow("Differential Drive plugin expected a positive integer for <pathLogWindow>, got " << value);
+      }
+      window = static_cast<size_t>(parsed);
+    }
+    double const max_deviation = parse_double("pathLogTolerance", tolerance);
+    if (!(max_deviation >= 0.0))
+    {
+      gzthrow("Differential Drive plugin expected a non-negative <pathLogTolerance>, got " << tolerance);
+    }
+    path_logger_.reset(new PathLogger(path_log_, max_deviation, window));
   }
 
-  if (!_sdf->HasElement("odomTopicName"))
-  {
-    ROS_WARN("Differential Drive plugin missing <odomTopicName>, defaults to odom");
-    this->odomTopicName = "odom";
-  }
-  else
+  if (get_flag(_sdf, row, "pipelined"))
   {
-    this->odomTopicName = _sdf->GetElement("odomTopicName")->GetValueString();
+    pipelined_ = true;
+    ROS_INFO("diffdrive plugin %s publishes odometry one step (%g s) behind physics",
+             parent->GetName().c_str(), this->world->GetPhysicsEngine()->GetStepTime());
   }
 
-  if (!_sdf->HasElement("wheelTopicName"))
-  {
-    ROS_WARN("Differential Drive plugin missing <wheelTopicName>, defaults to wheel_odom");
-    this->wheelOdomTopicName = "wheel_odom";
-  }
-  else
+  // Replace cmd_vel with the commands recorded for commandLogId, which
+  // defaults to the model name.
+  std::string command_log;
+  if (find_param(_sdf, row, "commandLog", command_log))
   {
-    this->wheelOdomTopicName = _sdf->GetElement("wheelTopicName")->GetValueString();
+    std::string command_log_id = this->parent->GetName();
+    find_param(_sdf, row, "commandLogId", command_log_id);
+
+    command_log_ = CommandLog::Get(command_log);
+    CommandLog::Track track;
+    if (command_log_->Find(command_log_id, track))
+    {
+      command_cursor_ = CommandCursor(track);
+    }
+    else
+    {
+      ROS_WARN("Differential Drive plugin found no commands for %s in %s, the robot will stay still",
+               command_log_id.c_str(), command_log.c_str());
+    }
   }
 
-  if (!_sdf->HasElement("baseFrame"))
+  // CPU seconds per simulated second; zero disables the accounting.
+  cpu_budget_ = 0.0;
+  std::string budget;
+  if (find_param(_sdf, row, "cpuBudget", budget))
   {
-    ROS_WARN("Differential Drive plugin missing <baseFrame>, defaults to base_footprint");
-    this->tf_base_frame_ = "base_footprint";
-  }
-  else
-  {
-    this->tf_base_frame_ = _sdf->GetElement("baseFrame")->GetValueString(); 
+    cpu_budget_ = parse_double("cpuBudget", budget);
   }
 
-  if (!_sdf->HasElement("odomFrame"))
-  {
-    ROS_WARN("Differential Drive plugin missing <odomFrame>, defaults to odom");
-    this->tf_odom_frame_ = "odom";
-  }
-  else
-  {
-    this->tf_odom_frame_ = _sdf->GetElement("odomFrame")->GetValueString(); 
-  }
-
-  if (!_sdf->HasElement("alpha"))
-  {
-    ROS_WARN("Differential Drive plugin missing <alpha>, defaults to 0.0");
-    this->alpha = 0.0;
-  }
-  else
-  {
-    this->alpha = _sdf->GetElement("alpha")->GetValueDouble();
-  }
-
-  if (!_sdf->HasElement("updateRate"))
-  {
-    ROS_WARN("Differential Drive plugin missing <updateRate>, defaults to 50.0 ms");
-    rate_ = 50.0;
-  }
-  else
-  {
-    rate_ = _sdf->GetElement("updateRate")->GetValueDouble();
-  }
+  this->compact_odom_ = get_flag(_sdf, row, "compactOdometry");
+  this->allow_sleep_ = get_flag(_sdf, row, "allowSleep");
 
   wheelSpeed[RIGHT] = 0;
   wheelSpeed[LEFT] = 0;
@@ -219,6 +380,7 @@ void DiffDrivePlugin::Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
   x_ = 0;
   rot_ = 0;
   alive_ = true;
+  asleep_ = false;
 
   joints[LEFT] = this->parent->GetJoint(leftJointName);
   joints[RIGHT] = this->parent->GetJoint(rightJointName);
@@ -226,25 +388,21 @@ void DiffDrivePlugin::Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
   if (!joints[LEFT])  { gzthrow("The controller couldn't get left hinge joint"); }
   if (!joints[RIGHT]) { gzthrow("The controller couldn't get right hinge joint"); }
 
+  // Read the model's state from the snapshot shared by the whole world.
+  world_snapshot_ = WorldSnapshot::Get(this->world);
+  world_snapshot_slot_ = world_snapshot_->Register(this->parent);
+
+  // Let the physics engine disable the model's bodies while it is parked.
+  if (allow_sleep_)
+  {
+    this->parent->SetAutoDisable(true);
+  }
+
   // Initialize the ROS node and subscribe to cmd_vel
   int argc = 0;
   char** argv = NULL;
   ros::init(argc, argv, "diff_drive_plugin", ros::init_options::NoSigintHandler | ros::init_options::AnonymousName);
-  rosnode_ = new ros::NodeHandle(this->robotNamespace);
-
-  ROS_INFO("starting diffdrive plugin in ns: %s", this->robotNamespace.c_str());
-
-  tf_prefix_ = tf::getPrefixParam(*rosnode_);
-  transform_broadcaster_ = new tf::TransformBroadcaster();
-
-  // ROS: Subscribe to the velocity command topic (usually "cmd_vel")
-  ros::SubscribeOptions so =
-      ros::SubscribeOptions::create<geometry_msgs::Twist>(twistTopicName, 1,
-                                                          boost::bind(&DiffDrivePlugin::cmdVelCallback, this, _1),
-                                                          ros::VoidPtr(), &queue_);
-  sub_ = rosnode_->subscribe(so);
-  pub_odom_  = rosnode_->advertise<nav_msgs::Odometry>(odomTopicName, 1);
-  pub_wheel_ = rosnode_->advertise<robot_kf::WheelOdometry>(wheelOdomTopicName, 10);
+  ConnectRos(this->robotNamespace);
 
   // Initialize the controller
   // Reset odometric pose
@@ -257,14 +415,94 @@ void DiffDrivePlugin::Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
   odomVel[2] = 0.0;
 
   // start custom queue for diff drive
-  this->callback_queue_thread_ = boost::thread(boost::bind(&DiffDrivePlugin::QueueThread, this));
+  StartQueueThread();
+  StartPipelineThread();
+
+  if (get_flag(_sdf, row, "reportMemory"))
+  {
+    ReportMemoryFootprint();
+  }
+
+  // Let PrepareBranch() find the instance.
+  {
+    boost::mutex::scoped_lock guard(instances_lock_);
+    instances_.insert(this);
+  }
 
   // listen to the update event (broadcast every simulation iteration)
   this->updateConnection = event::Events::ConnectWorldUpdateStart(boost::bind(&DiffDrivePlugin::UpdateChild, this));
 }
 
+// Create the node handle, publishers and subscribers in the given namespace
+void DiffDrivePlugin::ConnectRos(std::string const &ns)
+{
+  rosnode_ = new ros::NodeHandle(ns);
+
+  ROS_INFO("starting diffdrive plugin in ns: %s", ns.c_str());
+
+  tf_prefix_ = tf::getPrefixParam(*rosnode_);
+
+  // All the instances that ask for it publish through one broadcaster.
+  if (shared_broadcaster_)
+  {
+    transform_broadcaster_ = shared_transform_broadcaster_.lock();
+    if (!transform_broadcaster_)
+    {
+      transform_broadcaster_.reset(new tf::TransformBroadcaster());
+      shared_transform_broadcaster_ = transform_broadcaster_;
+    }
+  }
+  else
+  {
+    transform_broadcaster_.reset(new tf::TransformBroadcaster());
+  }
+
+  // ROS: Subscribe to the velocity command topic (usually "cmd_vel")
+  if (!command_log_)
+  {
+    ros::SubscribeOptions so =
+        ros::SubscribeOptions::create<geometry_msgs::Twist>(twistTopicName, 1,
+                                                            boost::bind(&DiffDrivePlugin::cmdVelCallback, this, _1),
+                                                            ros::VoidPtr(), &queue_);
+    sub_ = rosnode_->subscribe(so);
+  }
+
+  // The compact message does not carry the frame ids, so publish them once as
+  // parameters alongside the topic instead.
+  if (compact_odom_)
+  {
+    pub_odom_ = rosnode_->advertise<erratic_gazebo_plugins::Odometry2D>(odomTopicName, 1);
+    rosnode_->setParam(odomTopicName + "/frame_id", tf::resolve(tf_prefix_, tf_odom_frame_));
+    rosnode_->setParam(odomTopicName + "/child_frame_id", tf::resolve(tf_prefix_, tf_base_frame_));
+  }
+  else
+  {
+    pub_odom_ = rosnode_->advertise<nav_msgs::Odometry>(odomTopicName, 1);
+  }
+  pub_wheel_ = rosnode_->advertise<robot_kf::WheelOdometry>(wheelOdomTopicName, 10);
+
+  if (cpu_budget_ > 0.0)
+  {
+    pub_diagnostics_ = rosnode_->advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+  }
+}
+
 // Update the controller
 void DiffDrivePlugin::UpdateChild()
+{
+  if (cpu_budget_ <= 0.0)
+  {
+    UpdateDrive();
+    return;
+  }
+
+  double const start = thread_cpu_time();
+  UpdateDrive();
+  cpu_update_ += thread_cpu_time() - start;
+  CheckBudget();
+}
+
+void DiffDrivePlugin::UpdateDrive()
 {
   // TODO: Step should be in a parameter of this function
   double wd, ws;
@@ -274,6 +512,46 @@ void DiffDrivePlugin::UpdateChild()
 
   GetPositionCmd();
 
+  // Stop touching the joints and pose of a robot that has no command and is
+  // at rest so that the physics engine can disable it. Any command wakes it.
+  if (allow_sleep_)
+  {
+    bool const idle = wheelSpeed[LEFT] == 0.0 && wheelSpeed[RIGHT] == 0.0;
+
+    if (!idle && asleep_)
+    {
+      // Nothing held the model at odomPose while it slept, so continue from
+      // wherever contacts left it instead of teleporting it back.
+      math::Pose const pose = world_snapshot_->Read(world_snapshot_slot_).pose;
+      odomPose[0] = pose.pos.x;
+      odomPose[1] = pose.pos.y;
+      odomPose[2] = pose.rot.GetYaw();
+
+      this->parent->SetEnabled(true);
+      asleep_ = false;
+    }
+    else if (idle && !asleep_
+          && fabs(joints[LEFT]->GetVelocity(0)) < rest_velocity
+          && fabs(joints[RIGHT]->GetVelocity(0)) < rest_velocity)
+    {
+      odomVel[0] = 0.0;
+      odomVel[1] = 0.0;
+      odomVel[2] = 0.0;
+
+      // Zero the motor targets, which may still hold a speed from before the command
+      // dropped, e.g. wheels stalled against an obstacle.
+      joints[LEFT]->SetVelocity(0, 0.0);
+      joints[RIGHT]->SetVelocity(0, 0.0);
+      asleep_ = true;
+    }
+
+    if (asleep_)
+    {
+      publish_odometry();
+      return;
+    }
+  }
+
   wd = wheelDiameter;
   ws = wheelSeparation;
 
@@ -308,6 +586,7 @@ void DiffDrivePlugin::UpdateChild()
 void DiffDrivePlugin::FiniChild()
 {
   alive_ = false;
+  StopPipelineThread();
   queue_.clear();
   queue_.disable();
   rosnode_->shutdown();
@@ -318,6 +597,16 @@ void DiffDrivePlugin::GetPositionCmd()
 {
   lock.lock();
 
+  // Replayed commands are applied by simulation time, not as they arrive.
+  if (command_log_)
+  {
+    double linear = 0.0;
+    double angular = 0.0;
+    command_cursor_.Get(this->world->GetSimTime().Double(), linear, angular);
+    x_ = linear;
+    rot_ = angular;
+  }
+
   double vr, va;
 
   vr = x_; //myIface->data->cmdVelocity.pos.x;
@@ -341,13 +630,426 @@ void DiffDrivePlugin::cmdVelCallback(const geometry_msgs::Twist::ConstPtr& cmd_m
   lock.unlock();
 }
 
+DiffDrivePlugin::Snapshot DiffDrivePlugin::GetSnapshot()
+{
+  WaitForPipeline();
+
+  Snapshot snapshot;
+  std::copy(odomPose, odomPose + 3, snapshot.odomPose);
+  std::copy(odomVel, odomVel + 3, snapshot.odomVel);
+  snapshot.last_time = last_time_;
+  snapshot.last_true_yaw = last_true_yaw_;
+  snapshot.last_odom_yaw = last_odom_yaw_;
+  snapshot.last_true_pos = last_true_pos_;
+  snapshot.last_odom_pos = last_odom_pos_;
+
+  std::ostringstream rng_state;
+  if (rng_) rng_state << *rng_;
+  else      rng_state << compact_rng_;
+  snapshot.rng = rng_state.str();
+
+  lock.lock();
+  snapshot.x = x_;
+  snapshot.rot = rot_;
+  lock.unlock();
+  return snapshot;
+}
+
+void DiffDrivePlugin::RestoreSnapshot(Snapshot const &snapshot)
+{
+  WaitForPipeline();
+
+  std::copy(snapshot.odomPose, snapshot.odomPose + 3, odomPose);
+  std::copy(snapshot.odomVel, snapshot.odomVel + 3, odomVel);
+  last_time_ = snapshot.last_time;
+  last_sample_time_ = snapshot.last_time;
+  last_true_yaw_ = snapshot.last_true_yaw;
+  last_odom_yaw_ = snapshot.last_odom_yaw;
+  last_true_pos_ = snapshot.last_true_pos;
+  last_odom_pos_ = snapshot.last_odom_pos;
+
+  std::istringstream rng_state(snapshot.rng);
+  if (rng_) rng_state >> *rng_;
+  else      rng_state >> compact_rng_;
+
+  lock.lock();
+  x_ = snapshot.x;
+  rot_ = snapshot.rot;
+  lock.unlock();
+}
+
+void DiffDrivePlugin::SetCommand(double linear, double angular)
+{
+  lock.lock();
+  x_ = linear;
+  rot_ = angular;
+  lock.unlock();
+}
+
+// Only the forking thread is copied into the child, so stop the worker
+// threads first rather than leave the child with a queue locked by a thread
+// that no longer exists. This runs on the physics thread, which is also the
+// one that keeps stepping the world in the child.
+void DiffDrivePlugin::PrepareBranch()
+{
+  instances_lock_.lock();
+
+  std::set<DiffDrivePlugin *>::iterator it;
+  for (it = instances_.begin(); it != instances_.end(); ++it)
+  {
+    DiffDrivePlugin *const plugin = *it;
+    plugin->queue_paused_ = plugin->alive_;
+    plugin->alive_ = false;
+  }
+
+  for (it = instances_.begin(); it != instances_.end(); ++it)
+  {
+    DiffDrivePlugin *const plugin = *it;
+    if (plugin->queue_paused_) plugin->callback_queue_thread_.join();
+
+    plugin->pipeline_paused_ = plugin->pipeline_running_;
+    plugin->StopPipelineThread();
+
+    if (plugin->path_logger_) plugin->path_logger_->Sync();
+  }
+}
+
+void DiffDrivePlugin::ResumeAfterBranch()
+{
+  std::set<DiffDrivePlugin *>::iterator it;
+  for (it = instances_.begin(); it != instances_.end(); ++it)
+  {
+    DiffDrivePlugin *const plugin = *it;
+    if (plugin->queue_paused_)
+    {
+      plugin->alive_ = true;
+      plugin->StartQueueThread();
+    }
+    if (plugin->pipeline_paused_) plugin->StartPipelineThread();
+    plugin->queue_paused_ = false;
+    plugin->pipeline_paused_ = false;
+  }
+  instances_lock_.unlock();
+}
+
+void DiffDrivePlugin::Branch(unsigned int branch)
+{
+  std::set<DiffDrivePlugin *>::iterator it;
+  for (it = instances_.begin(); it != instances_.end(); ++it)
+  {
+    (*it)->BranchChild(branch);
+  }
+  instances_lock_.unlock();
+}
+
+void DiffDrivePlugin::FinishBranch()
+{
+  boost::mutex::scoped_lock guard(instances_lock_);
+
+  std::set<DiffDrivePlugin *>::iterator it;
+  for (it = instances_.begin(); it != instances_.end(); ++it)
+  {
+    DiffDrivePlugin *const plugin = *it;
+    plugin->StopPipelineThread();
+    if (plugin->path_logger_) plugin->path_logger_->Close();
+  }
+}
+
+void DiffDrivePlugin::BranchChild(unsigned int branch)
+{
+  // Give every branch its own, reproducible noise sequence.
+  std::size_t branch_seed = seed_;
+  boost::hash_combine(branch_seed, branch);
+  SeedNoise(static_cast<boost::uint32_t>(branch_seed));
+
+  if (path_logger_)
+  {
+    path_logger_->Reopen(path_log_ + ".branch_" + boost::lexical_cast<std::string>(branch));
+  }
+
+  // The callback thread is only useful with ROS, so it is not restarted.
+  // roscpp's clock stops with its threads, so samples follow simulation time.
+  branched_ = true;
+  alive_ = false;
+  last_time_ = last_sample_time_ = Now();
+  queue_paused_ = false;
+  queue_.clear();
+
+  if (pipeline_paused_) StartPipelineThread();
+  pipeline_paused_ = false;
+}
+
+void DiffDrivePlugin::AddThreadTime(double seconds)
+{
+  if (cpu_budget_ <= 0.0) return;
+
+  boost::mutex::scoped_lock guard(budget_lock_);
+  cpu_threads_ += seconds;
+}
+
+// Compare the CPU time used in each second of simulated time with the budget.
+// A robot over budget sheds one optional output per window: first the path
+// log, then wheel odometry, then halves its odometry rate at each further
+// level, up to max_degrade_level. Outputs come back one at a time once it
+// stays under half of the budget.
+void DiffDrivePlugin::CheckBudget()
+{
+  double const now = this->world->GetSimTime().Double();
+  if (budget_window_start_ < 0.0 || now < budget_window_start_)
+  {
+    budget_window_start_ = now;
+    return;
+  }
+
+  double const elapsed = now - budget_window_start_;
+  if (elapsed < budget_window) return;
+
+  double cpu_threads;
+  {
+    boost::mutex::scoped_lock guard(budget_lock_);
+    cpu_threads = cpu_threads_;
+    cpu_threads_ = 0.0;
+  }
+  double const usage = (cpu_update_ + cpu_threads) / elapsed;
+
+  if (usage > cpu_budget_ && degrade_level_ < max_degrade_level)
+  {
+    ++degrade_level_;
+    if (!branched_) ROS_WARN("diffdrive plugin %s used %.3g CPU s/s against a budget of %.3g, degrading outputs to level %d",
+             parent->GetName().c_str(), usage, cpu_budget_, degrade_level_);
+  }
+  else if (usage < 0.5 * cpu_budget_ && degrade_level_ > 0)
+  {
+    --degrade_level_;
+  }
+
+  if (!branched_) PublishBudget(elapsed, cpu_threads, usage);
+
+  cpu_update_ = 0.0;
+  budget_window_start_ = now;
+}
+
+void DiffDrivePlugin::PublishBudget(double elapsed, double cpu_threads, double usage)
+{
+  diagnostic_msgs::DiagnosticStatus status;
+  status.name = "diffdrive_plugin: " + parent->GetName();
+  status.hardware_id = parent->GetName();
+  if (usage > cpu_budget_)
+  {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = "Over CPU budget";
+  }
+  else
+  {
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.message = "Within CPU budget";
+  }
+
+  std::pair<char const *, double> const values[] = {
+    std::make_pair("update_cpu", cpu_update_ / elapsed),
+    std::make_pair("thread_cpu", cpu_threads / elapsed),
+    std::make_pair("budget", cpu_budget_),
+    std::make_pair("degrade_level", static_cast<double>(degrade_level_)),
+  };
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+  {
+    diagnostic_msgs::KeyValue value;
+    value.key = values[i].first;
+    value.value = boost::lexical_cast<std::string>(values[i].second);
+    status.values.push_back(value);
+  }
+
+  diagnostic_msgs::DiagnosticArray diagnostics;
+  diagnostics.header.stamp = ros::Time::now();
+  diagnostics.status.push_back(status);
+  pub_diagnostics_.publish(diagnostics);
+}
+
+// Without ROS a branch has no clock but the simulation's.
+ros::Time DiffDrivePlugin::Now() const
+{
+  if (!branched_) return ros::Time::now();
+
+  common::Time const now = this->world->GetSimTime();
+  return ros::Time(now.sec, now.nsec);
+}
+
+// Every thread of the plugin gets the stack size from <threadStackSize>.
+void DiffDrivePlugin::StartThread(boost::thread &thread, void (DiffDrivePlugin::*body)())
+{
+#if BOOST_VERSION >= 105000
+  boost::thread::attributes attributes;
+  if (thread_stack_size_ > 0)
+  {
+    attributes.set_stack_size(thread_stack_size_);
+  }
+  thread = boost::thread(attributes, boost::bind(body, this));
+#else
+  thread = boost::thread(boost::bind(body, this));
+#endif
+}
+
+void DiffDrivePlugin::StartQueueThread()
+{
+  StartThread(this->callback_queue_thread_, &DiffDrivePlugin::QueueThread);
+}
+
+void DiffDrivePlugin::WaitForPipeline()
+{
+  boost::mutex::scoped_lock guard(pipeline_lock_);
+  while (pipeline_full_)
+  {
+    pipeline_cond_.wait(guard);
+  }
+}
+
+void DiffDrivePlugin::StartPipelineThread()
+{
+  if (pipelined_)
+  {
+    pipeline_running_ = true;
+    StartThread(this->pipeline_thread_, &DiffDrivePlugin::PipelineThread);
+  }
+}
+
+void DiffDrivePlugin::StopPipelineThread()
+{
+  if (pipeline_running_)
+  {
+    {
+      boost::mutex::scoped_lock guard(pipeline_lock_);
+      pipeline_running_ = false;
+      pipeline_cond_.notify_all();
+    }
+    pipeline_thread_.join();
+  }
+}
+
+void DiffDrivePlugin::PipelineThread()
+{
+  boost::mutex::scoped_lock guard(pipeline_lock_);
+
+  for (;;)
+  {
+    while (!pipeline_full_ && pipeline_running_)
+    {
+      pipeline_cond_.wait(guard);
+    }
+    if (!pipeline_full_) break;
+
+    // Physics cannot post the next sample until this one is done.
+    OdometrySample const sample = pipeline_sample_;
+    guard.unlock();
+    if (cpu_budget_ > 0.0)
+    {
+      double const start = thread_cpu_time();
+      process_odometry(sample);
+      AddThreadTime(thread_cpu_time() - start);
+    }
+    else
+    {
+      process_odometry(sample);
+    }
+    guard.lock();
+
+    pipeline_full_ = false;
+    pipeline_cond_.notify_all();
+  }
+}
+
 void DiffDrivePlugin::QueueThread()
 {
   static const double timeout = 0.01;
 
   while (alive_ && rosnode_->ok())
   {
+    if (cpu_budget_ <= 0.0)
+    {
+      queue_.callAvailable(ros::WallDuration(timeout));
+      continue;
+    }
+
+    double const start = thread_cpu_time();
     queue_.callAvailable(ros::WallDuration(timeout));
+    AddThreadTime(thread_cpu_time() - start);
+  }
+}
+
+void DiffDrivePlugin::SeedNoise(boost::uint32_t seed)
+{
+  if (rng_) rng_->seed(seed);
+  else      compact_rng_.seed(seed);
+}
+
+double DiffDrivePlugin::SampleNoise(normal_dist const &dist)
+{
+  if (rng_) return sample(*rng_, dist);
+  else      return sample(compact_rng_, dist);
+}
+
+std::map<std::string, size_t> DiffDrivePlugin::GetMemoryFootprint() const
+{
+  std::map<std::string, size_t> footprint;
+  footprint["plugin"] = sizeof(*this);
+  footprint["rng"] = rng_ ? sizeof(RNGType) : 0;
+  footprint["node_handle"] = rosnode_ ? sizeof(ros::NodeHandle) : 0;
+
+  // A shared broadcaster is split between the instances that use it.
+  footprint["transform_broadcaster"] = transform_broadcaster_
+    ? sizeof(tf::TransformBroadcaster) / transform_broadcaster_.use_count() : 0;
+
+  // One slot of the world's snapshot, plus a share of the snapshot itself.
+  footprint["world_snapshot"] = world_snapshot_
+    ? sizeof(WorldSnapshot::Entry) + sizeof(physics::ModelPtr) + sizeof(WorldSnapshot) / world_snapshot_.use_count() : 0;
+
+  footprint["path_logger"] = path_logger_ ? path_logger_->GetMemoryFootprint() : 0;
+  return footprint;
+}
+
+std::map<std::string, size_t> DiffDrivePlugin::GetStackReservation() const
+{
+  size_t stack_size = thread_stack_size_;
+  if (stack_size == 0 || BOOST_VERSION < 105000)
+  {
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_getstacksize(&attributes, &stack_size);
+    pthread_attr_destroy(&attributes);
+  }
+
+  std::map<std::string, size_t> reservation;
+  reservation["queue_thread"] = stack_size;
+  if (pipelined_)
+  {
+    reservation["pipeline_thread"] = stack_size;
+  }
+  return reservation;
+}
+
+void DiffDrivePlugin::ReportMemoryFootprint() const
+{
+  if (branched_) return;
+
+  std::map<std::string, size_t> const footprint = GetMemoryFootprint();
+
+  size_t total = 0;
+  std::map<std::string, size_t>::const_iterator it;
+  for (it = footprint.begin(); it != footprint.end(); ++it)
+  {
+    ROS_INFO("diffdrive plugin %s: %s uses %lu bytes",
+             parent->GetName().c_str(), it->first.c_str(), static_cast<unsigned long>(it->second));
+    total += it->second;
+  }
+  ROS_INFO("diffdrive plugin %s: %lu bytes in total",
+           parent->GetName().c_str(), static_cast<unsigned long>(total));
+
+  // Stacks are reserved address space; only the pages a thread touches count
+  // towards RSS, so they are not part of the total.
+  std::map<std::string, size_t> const reservation = GetStackReservation();
+  for (it = reservation.begin(); it != reservation.end(); ++it)
+  {
+    ROS_INFO("diffdrive plugin %s: %s reserves %lu bytes of stack",
+             parent->GetName().c_str(), it->first.c_str(), static_cast<unsigned long>(it->second));
   }
 }
 
@@ -371,10 +1073,8 @@ DiffDrivePlugin::OdometryUpdate DiffDrivePlugin::generateError(
   double const sigma_right = std::max(fabs(alpha * v_right), min_variance);
   normal_dist const dist_left(v_left, sigma_left);
   normal_dist const dist_right(v_right, sigma_right);
-  normal_gen gen_noisy_left(rng_, dist_left);
-  normal_gen gen_noisy_right(rng_, dist_right);
-  double const noisy_v_left  = gen_noisy_left();
-  double const noisy_v_right = gen_noisy_right();
+  double const noisy_v_left  = SampleNoise(dist_left);
+  double const noisy_v_right = SampleNoise(dist_right);
 
   // Convert back from encoder ticks to polar coordinates.
   double const noisy_delta_linear = 0.5 * (noisy_v_left + noisy_v_right);
@@ -396,15 +1096,45 @@ void DiffDrivePlugin::publish_odometry()
   typedef boost::variate_generator<boost::mt19937 &, boost::normal_distribution<> > normal_generator;
 
   // Throttle the update rate to the user-defined period.
-  ros::Time const curr_time = ros::Time::now();
-  double const delta_time = (curr_time - last_time_).toSec();
-  if (delta_time < 0.001 * rate_) return;
-  
+  ros::Time const curr_time = Now();
+  double const delta_time = (curr_time - last_sample_time_).toSec();
+  double const period = 0.001 * rate_ * (1 << std::max(degrade_level_ - 2, 0));
+  if (delta_time < period) return;
+  last_sample_time_ = curr_time;
+
+  // Get the actual pose from Gazebo.
+  OdometrySample sample;
+  sample.time = curr_time;
+  sample.degrade_level = degrade_level_;
+  sample.state = world_snapshot_->Read(world_snapshot_slot_);
+
+  // In pipelined mode the rest happens on the worker thread while physics
+  // computes the next step. The worker is never more than one sample behind.
+  if (pipelined_)
+  {
+    boost::mutex::scoped_lock guard(pipeline_lock_);
+    while (pipeline_full_)
+    {
+      pipeline_cond_.wait(guard);
+    }
+    pipeline_sample_ = sample;
+    pipeline_full_ = true;
+    pipeline_cond_.notify_all();
+  }
+  else
+  {
+    process_odometry(sample);
+  }
+}
+
+void DiffDrivePlugin::process_odometry(OdometrySample const &sample)
+{
+  ros::Time const &curr_time = sample.time;
   std::string const odom_frame = tf::resolve(tf_prefix_, tf_odom_frame_);
   std::string const base_footprint_frame = tf::resolve(tf_prefix_, tf_base_frame_);
 
-  // Get the actual pose from Gazebo.
-  math::Pose const pose = parent->GetState().GetPose();
+  WorldSnapshot::Entry const &state = sample.state;
+  math::Pose const &pose = state.pose;
   btVector3 const curr_true_pos(pose.pos.x, pose.pos.y, pose.pos.z);
   btQuaternion const curr_true_qt(pose.rot.x, pose.rot.y, pose.rot.z, pose.rot.w);
   double const curr_true_yaw = tf::getYaw(curr_true_qt);
@@ -412,47 +1142,82 @@ void DiffDrivePlugin::publish_odometry()
   // Add encoder noise.
   OdometryUpdate const update = generateError(curr_true_pos, curr_true_yaw);
 
-  // Publish the Odometry message.
-  nav_msgs::Odometry odom;
-  odom.header.stamp = curr_time;
-  odom.header.frame_id = odom_frame;
-  odom.child_frame_id = base_footprint_frame;
-  odom.pose.pose.position.x = update.curr_odom_pos[0];
-  odom.pose.pose.position.y = update.curr_odom_pos[1];
-  odom.pose.pose.orientation = tf::createQuaternionMsgFromYaw(update.curr_odom_yaw);
-
-  // FIXME: This velocity should be corrupted by the same noise as the
-  // position estimate, since both would be estimated by the same sensor.
-  math::Vector3 const v_linear = parent->GetWorldLinearVel();
-  math::Vector3 const v_angular = parent->GetWorldAngularVel();
-  odom.twist.twist.linear.x = v_linear.x;
-  odom.twist.twist.linear.y = v_linear.y;
-  odom.twist.twist.angular.z = v_angular.z;
-  pub_odom_.publish(odom);
-
-  // FIXME: Hack.
-  double const beta = 1;
-
-  // Publish the WheelOdometry message.
-  double const stddev_left  = std::max(fabs(alpha * update.v_left), min_variance);
-  double const stddev_right = std::max(fabs(alpha * update.v_right), min_variance);
-  robot_kf::WheelOdometry wheel_odom;
-  wheel_odom.header.stamp = curr_time;
-  wheel_odom.header.frame_id = base_footprint_frame;
-  wheel_odom.timestep = curr_time - last_time_;
-  wheel_odom.separation = wheelSeparation;
-  wheel_odom.left.movement = update.v_left;
-  wheel_odom.left.variance = pow(beta * stddev_left, 2);
-  wheel_odom.right.movement = update.v_right;
-  wheel_odom.right.variance = pow(beta * stddev_right, 2);
-  pub_wheel_.publish(wheel_odom);
-
-  // Broadcast the corresponding TF transform from /odom to /base_footprint.
-  tf::Quaternion const curr_odom_qt = tf::createQuaternionFromYaw(update.curr_odom_yaw);
-  tf::Transform const base_footprint_to_odom(curr_odom_qt, update.curr_odom_pos);
-  transform_broadcaster_->sendTransform(
-    tf::StampedTransform(
-      base_footprint_to_odom, curr_time, odom_frame, base_footprint_frame));
+  if (path_logger_ && sample.degrade_level < 1)
+  {
+    PathVertex const odom_vertex = {
+      curr_time.toSec(), update.curr_odom_pos[0], update.curr_odom_pos[1], update.curr_odom_yaw };
+    PathVertex const true_vertex = {
+      curr_time.toSec(), curr_true_pos[0], curr_true_pos[1], curr_true_yaw };
+    path_logger_->Log(odom_vertex, true_vertex);
+  }
+
+  // A branch cannot reach ROS after fork(); its results are the path log and
+  // GetSnapshot().
+  if (!branched_)
+  {
+    // FIXME: Hack.
+    double const beta = 1;
+    double const stddev_left  = std::max(fabs(alpha * update.v_left), min_variance);
+    double const stddev_right = std::max(fabs(alpha * update.v_right), min_variance);
+    double const variance_left  = pow(beta * stddev_left, 2);
+    double const variance_right = pow(beta * stddev_right, 2);
+
+    // FIXME: This velocity should be corrupted by the same noise as the
+    // position estimate, since both would be estimated by the same sensor.
+    math::Vector3 const &v_linear = state.linear_vel;
+    math::Vector3 const &v_angular = state.angular_vel;
+
+    // Publish the Odometry message.
+    if (compact_odom_)
+    {
+      erratic_gazebo_plugins::Odometry2D odom;
+      odom.stamp = curr_time;
+      odom.x = update.curr_odom_pos[0];
+      odom.y = update.curr_odom_pos[1];
+      odom.yaw = update.curr_odom_yaw;
+      odom.v = v_linear.x * cos(curr_true_yaw) + v_linear.y * sin(curr_true_yaw);
+      odom.omega = v_angular.z;
+      odom.linear_variance = 0.25 * (variance_left + variance_right);
+      odom.angular_variance = (variance_left + variance_right) / pow(wheelSeparation, 2);
+      pub_odom_.publish(odom);
+    }
+    else
+    {
+      nav_msgs::Odometry odom;
+      odom.header.stamp = curr_time;
+      odom.header.frame_id = odom_frame;
+      odom.child_frame_id = base_footprint_frame;
+      odom.pose.pose.position.x = update.curr_odom_pos[0];
+      odom.pose.pose.position.y = update.curr_odom_pos[1];
+      odom.pose.pose.orientation = tf::createQuaternionMsgFromYaw(update.curr_odom_yaw);
+      odom.twist.twist.linear.x = v_linear.x;
+      odom.twist.twist.linear.y = v_linear.y;
+      odom.twist.twist.angular.z = v_angular.z;
+      pub_odom_.publish(odom);
+    }
+
+    // Publish the WheelOdometry message.
+    if (sample.degrade_level < 2)
+    {
+      robot_kf::WheelOdometry wheel_odom;
+      wheel_odom.header.stamp = curr_time;
+      wheel_odom.header.frame_id = base_footprint_frame;
+      wheel_odom.timestep = curr_time - last_time_;
+      wheel_odom.separation = wheelSeparation;
+      wheel_odom.left.movement = update.v_left;
+      wheel_odom.left.variance = variance_left;
+      wheel_odom.right.movement = update.v_right;
+      wheel_odom.right.variance = variance_right;
+      pub_wheel_.publish(wheel_odom);
+    }
+
+    // Broadcast the corresponding TF transform from /odom to /base_footprint.
+    tf::Quaternion const curr_odom_qt = tf::createQuaternionFromYaw(update.curr_odom_yaw);
+    tf::Transform const base_footprint_to_odom(curr_odom_qt, update.curr_odom_pos);
+    transform_broadcaster_->sendTransform(
+      tf::StampedTransform(
+        base_footprint_to_odom, curr_time, odom_frame, base_footprint_frame));
+  }
 
   last_time_ = curr_time;
   last_true_pos_ = curr_true_pos;
@@ -474,7 +1239,7 @@ void DiffDrivePlugin::write_position_data()
   // pos_iface_->data->velocity.pos.x = odomVel[0];
   // pos_iface_->data->velocity.yaw = odomVel[2];
 
-  math::Pose orig_pose = this->parent->GetWorldPose();
+  math::Pose orig_pose = world_snapshot_->Read(world_snapshot_slot_).pose;
 
   math::Pose new_pose = orig_pose;
   new_pose.pos.x = odomPose[0];
@@ -482,8 +1247,13 @@ void DiffDrivePlugin::write_position_data()
   new_pose.rot.SetFromEuler(math::Vector3(0,0,odomPose[2]));
 
   this->parent->SetWorldPose( new_pose );
+  world_snapshot_->SetPose(world_snapshot_slot_, new_pose);
 }
 
+boost::mutex DiffDrivePlugin::instances_lock_;
+std::set<DiffDrivePlugin *> DiffDrivePlugin::instances_;
+boost::weak_ptr<tf::TransformBroadcaster> DiffDrivePlugin::shared_transform_broadcaster_;
+
 GZ_REGISTER_MODEL_PLUGIN(DiffDrivePlugin)
 }
 
@@ -0,0 +1,81 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <erratic_gazebo_plugins/mapped_file.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gazebo.h>
+#include <common/Exception.hh>
+
+namespace gazebo
+{
+
+MappedFile::MappedFile(std::string const &_path)
+  : path_(_path)
+  , data_(NULL)
+  , size_(0)
+{
+  int const fd = open(_path.c_str(), O_RDONLY);
+  if (fd < 0) { gzthrow("Unable to open " << _path); }
+
+  struct stat info;
+  if (fstat(fd, &info) < 0)
+  {
+    close(fd);
+    gzthrow("Unable to stat " << _path);
+  }
+  size_ = info.st_size;
+
+  // mmap() refuses empty mappings, so leave an empty file unmapped.
+  if (size_ > 0)
+  {
+    void *const data = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      close(fd);
+      gzthrow("Unable to map " << _path);
+    }
+    data_ = static_cast<char const *>(data);
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if (data_)
+  {
+    munmap(const_cast<char *>(data_), size_);
+  }
+}
+
+}
+
+/* vim: set ts=2 sts=2 sw=2: */
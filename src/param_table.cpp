@@ -0,0 +1,137 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <erratic_gazebo_plugins/param_table.h>
+#include <erratic_gazebo_plugins/mapped_file.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gazebo.h>
+#include <common/Exception.hh>
+
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace gazebo
+{
+
+static void split_line(char const *begin, char const *end, std::vector<std::string> &fields)
+{
+  fields.clear();
+
+  char const *field = begin;
+  for (char const *it = begin; it <= end; ++it)
+  {
+    if (it == end || *it == ',')
+    {
+      fields.push_back(boost::algorithm::trim_copy(std::string(field, it)));
+      field = it + 1;
+    }
+  }
+}
+
+boost::shared_ptr<ParamTable const> ParamTable::Get(std::string const &_path)
+{
+  typedef std::map<std::string, boost::shared_ptr<ParamTable const> > TableMap;
+  static boost::mutex mutex;
+  static TableMap tables;
+
+  boost::mutex::scoped_lock guard(mutex);
+
+  TableMap::const_iterator const it = tables.find(_path);
+  if (it != tables.end())
+  {
+    return it->second;
+  }
+
+  boost::shared_ptr<ParamTable const> const table(new ParamTable(_path));
+  tables[_path] = table;
+  return table;
+}
+
+ParamTable::Row const *ParamTable::Find(std::string const &_model) const
+{
+  std::map<std::string, Row>::const_iterator const it = rows_.find(_model);
+  return (it != rows_.end()) ? &it->second : NULL;
+}
+
+ParamTable::ParamTable(std::string const &_path)
+{
+  MappedFile const file(_path);
+  char const *const data = file.GetData();
+  char const *const end = data + file.GetSize();
+
+  std::vector<std::string> header;
+  std::vector<std::string> fields;
+  int line_number = 0;
+
+  for (char const *line = data; line < end; )
+  {
+    char const *line_end = std::find(line, end, '\n');
+    char const *const next = (line_end == end) ? end : line_end + 1;
+    if (line_end > line && line_end[-1] == '\r') --line_end;
+    ++line_number;
+
+    if (line_end == line || *line == '#')
+    {
+      line = next;
+      continue;
+    }
+
+    if (header.empty())
+    {
+      split_line(line, line_end, header);
+      columns_.assign(header.begin() + 1, header.end());
+    }
+    else
+    {
+      split_line(line, line_end, fields);
+      if (fields.size() != header.size())
+      {
+        gzthrow(_path << ":" << line_number << ": expected " << header.size()
+                << " columns, found " << fields.size());
+      }
+
+      if (rows_.count(fields[0]))
+      {
+        gzthrow(_path << ":" << line_number << ": duplicate row for " << fields[0]);
+      }
+
+      Row &row = rows_[fields[0]];
+      for (size_t i = 1; i < fields.size(); ++i)
+      {
+        if (!fields[i].empty()) row[header[i]] = fields[i];
+      }
+    }
+    line = next;
+  }
+}
+
+}
+
+/* vim: set ts=2 sts=2 sw=2: */
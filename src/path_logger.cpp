@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <erratic_gazebo_plugins/path_logger.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <gazebo.h>
+#include <common/Exception.hh>
+
+namespace gazebo
+{
+
+static double segment_distance(PathVertex const &a, PathVertex const &b, PathVertex const &p)
+{
+  double const dx = b.x - a.x;
+  double const dy = b.y - a.y;
+  double const length_sq = dx * dx + dy * dy;
+
+  double s = 0.0;
+  if (length_sq > 0.0)
+  {
+    s = ((p.x - a.x) * dx + (p.y - a.y) * dy) / length_sq;
+    s = std::max(0.0, std::min(1.0, s));
+  }
+  return hypot(a.x + s * dx - p.x, a.y + s * dy - p.y);
+}
+
+PathSimplifier::PathSimplifier(double _tolerance, size_t _window)
+  : tolerance_(_tolerance)
+  , window_(std::max<size_t>(_window, 1))
+  , started_(false)
+{
+}
+
+bool PathSimplifier::Add(PathVertex const &_sample, PathVertex &_vertex)
+{
+  if (!started_)
+  {
+    started_ = true;
+    anchor_ = _sample;
+    _vertex = _sample;
+    return true;
+  }
+
+  bool fits = pending_.size() < window_;
+  for (size_t i = 0; fits && i < pending_.size(); ++i)
+  {
+    fits = segment_distance(anchor_, _sample, pending_[i]) <= tolerance_;
+  }
+
+  if (fits)
+  {
+    pending_.push_back(_sample);
+    return false;
+  }
+
+  // The previous sample ends the current segment and starts the next one.
+  anchor_ = pending_.back();
+  _vertex = anchor_;
+  pending_.clear();
+  pending_.push_back(_sample);
+  return true;
+}
+
+bool PathSimplifier::Flush(PathVertex &_vertex)
+{
+  if (pending_.empty()) return false;
+
+  anchor_ = pending_.back();
+  _vertex = anchor_;
+  pending_.clear();
+  return true;
+}
+
+bool PathSimplifier::GetAnchor(PathVertex &_vertex) const
+{
+  _vertex = anchor_;
+  return started_;
+}
+
+size_t PathSimplifier::GetMemoryFootprint() const
+{
+  return std::max(pending_.capacity(), window_) * sizeof(PathVertex);
+}
+
+PathLogger::PathLogger(std::string const &_path, double _tolerance, size_t _window)
+  : odom_(_tolerance, _window)
+  , truth_(_tolerance, _window)
+{
+  Reopen(_path);
+}
+
+PathLogger::~PathLogger()
+{
+  Close();
+}
+
+void PathLogger::Log(PathVertex const &_odom, PathVertex const &_truth)
+{
+  PathVertex vertex;
+  if (odom_.Add(_odom, vertex)) Write("odom", vertex);
+  if (truth_.Add(_truth, vertex)) Write("true", vertex);
+}
+
+void PathLogger::Sync()
+{
+  file_.flush();
+}
+
+size_t PathLogger::GetMemoryFootprint() const
+{
+  // The filebuf allocates a BUFSIZ buffer when the file is opened.
+  return sizeof(*this) + BUFSIZ + odom_.GetMemoryFootprint() + truth_.GetMemoryFootprint();
+}
+
+void PathLogger::Close()
+{
+  if (!file_.is_open()) return;
+
+  PathVertex vertex;
+  if (odom_.Flush(vertex)) Write("odom", vertex);
+  if (truth_.Flush(vertex)) Write("true", vertex);
+  file_.close();
+}
+
+void PathLogger::Reopen(std::string const &_path)
+{
+  if (file_.is_open()) file_.close();
+
+  file_.open(_path.c_str(), std::ios::out | std::ios::trunc);
+  if (!file_) { gzthrow("Unable to open path log " << _path); }
+  file_.precision(9);
+
+  PathVertex vertex;
+  if (odom_.GetAnchor(vertex)) Write("odom", vertex);
+  if (truth_.GetAnchor(vertex)) Write("true", vertex);
+}
+
+void PathLogger::Write(char const *_tag, PathVertex const &_vertex)
+{
+  file_ << _tag << ' ' << _vertex.t << ' ' << _vertex.x << ' ' << _vertex.y << ' ' << _vertex.yaw << '\n';
+}
+
+}
+
+/* vim: set ts=2 sts=2 sw=2: */
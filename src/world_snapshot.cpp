@@ -0,0 +1,116 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <erratic_gazebo_plugins/world_snapshot.h>
+
+#include <map>
+#include <string>
+
+#include <physics/Model.hh>
+#include <physics/World.hh>
+
+#include <boost/weak_ptr.hpp>
+
+namespace gazebo
+{
+
+boost::shared_ptr<WorldSnapshot> WorldSnapshot::Get(physics::WorldPtr _world)
+{
+  typedef std::map<std::string, boost::weak_ptr<WorldSnapshot> > SnapshotMap;
+  static boost::mutex mutex;
+  static SnapshotMap snapshots;
+
+  boost::mutex::scoped_lock guard(mutex);
+
+  boost::shared_ptr<WorldSnapshot> snapshot = snapshots[_world->GetName()].lock();
+  if (!snapshot)
+  {
+    snapshot.reset(new WorldSnapshot(_world));
+    snapshots[_world->GetName()] = snapshot;
+  }
+  return snapshot;
+}
+
+WorldSnapshot::WorldSnapshot(physics::WorldPtr _world)
+  : world_(_world)
+  , valid_(false)
+{
+}
+
+size_t WorldSnapshot::Register(physics::ModelPtr _model)
+{
+  boost::mutex::scoped_lock guard(mutex_);
+  models_.push_back(_model);
+  entries_.push_back(Entry());
+  valid_ = false;
+  return models_.size() - 1;
+}
+
+void WorldSnapshot::Unregister(size_t _slot)
+{
+  boost::mutex::scoped_lock guard(mutex_);
+  models_[_slot].reset();
+}
+
+WorldSnapshot::Entry WorldSnapshot::Read(size_t _slot)
+{
+  boost::mutex::scoped_lock guard(mutex_);
+
+  Refresh();
+  return entries_[_slot];
+}
+
+void WorldSnapshot::SetPose(size_t _slot, math::Pose const &_pose)
+{
+  boost::mutex::scoped_lock guard(mutex_);
+
+  Refresh();
+  entries_[_slot].pose = _pose;
+}
+
+void WorldSnapshot::Refresh()
+{
+  common::Time const now = world_->GetSimTime();
+  if (valid_ && now == stamp_) return;
+  stamp_ = now;
+  valid_ = true;
+
+  for (size_t i = 0; i < models_.size(); ++i)
+  {
+    physics::ModelPtr const &model = models_[i];
+    if (!model) continue;
+
+    Entry &entry = entries_[i];
+    entry.pose = model->GetWorldPose();
+    entry.linear_vel = model->GetWorldLinearVel();
+    entry.angular_vel = model->GetWorldAngularVel();
+  }
+}
+
+}
+
+/* vim: set ts=2 sts=2 sw=2: */
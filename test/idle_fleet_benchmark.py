@@ -0,0 +1,136 @@
+#!/usr/bin/env python
+"""
+Compares how fast gzserver steps a fleet of parked differential drive robots
+with and without <allowSleep>.
+
+For each setting a world with --robots copies of a minimal two-wheeled model
+is generated and run for --duration wall seconds with an unthrottled update
+rate; the ratio of simulated to wall time reported by gzstats is the measure
+of solver cost. No robot ever receives a command, so with <allowSleep> every
+robot should be disabled by ODE shortly after it settles.
+
+Needs a running roscore and the package built, e.g.
+
+    rosrun erratic_gazebo_plugins idle_fleet_benchmark.py --robots 200
+"""
+import argparse
+import os
+import re
+import signal
+import subprocess
+import tempfile
+import time
+
+ROBOT = """
+    <model name="robot_{index}">
+      <origin pose="{x} {y} 0.1 0 0 0"/>
+      <link name="chassis">
+        <inertial mass="5.0"/>
+        <collision name="collision">
+          <geometry><box size="0.4 0.3 0.1"/></geometry>
+        </collision>
+      </link>
+      <link name="left_wheel">
+        <origin pose="0 0.17 0 1.5707 0 0"/>
+        <inertial mass="0.5"/>
+        <collision name="collision">
+          <geometry><cylinder radius="0.075" length="0.03"/></geometry>
+        </collision>
+      </link>
+      <link name="right_wheel">
+        <origin pose="0 -0.17 0 1.5707 0 0"/>
+        <inertial mass="0.5"/>
+        <collision name="collision">
+          <geometry><cylinder radius="0.075" length="0.03"/></geometry>
+        </collision>
+      </link>
+      <joint name="left_joint" type="revolute">
+        <parent link="chassis"/>
+        <child link="left_wheel"/>
+        <axis xyz="0 1 0"/>
+      </joint>
+      <joint name="right_joint" type="revolute">
+        <parent link="chassis"/>
+        <child link="right_wheel"/>
+        <axis xyz="0 1 0"/>
+      </joint>
+      <plugin name="diffdrive_{index}" filename="libdiffdrive_plugin.so">
+        <robotNamespace>robot_{index}</robotNamespace>
+        <leftJoint>left_joint</leftJoint>
+        <rightJoint>right_joint</rightJoint>
+        <wheelSeparation>0.34</wheelSeparation>
+        <wheelDiameter>0.15</wheelDiameter>
+        <torque>5.0</torque>
+        <allowSleep>{allow_sleep}</allowSleep>
+      </plugin>
+    </model>
+"""
+
+WORLD = """<?xml version="1.0"?>
+<gazebo version="1.0">
+  <world name="default">
+    <physics type="ode" update_rate="0"/>
+    <model name="ground" static="true">
+      <link name="plane">
+        <collision name="collision">
+          <geometry><plane normal="0 0 1"/></geometry>
+        </collision>
+      </link>
+    </model>
+{robots}
+  </world>
+</gazebo>
+"""
+
+STATS = re.compile(r'SimTime\[([0-9.]+)\]\s*RealTime\[([0-9.]+)\]')
+
+
+def write_world(robots, allow_sleep):
+    side = max(1, int(robots ** 0.5))
+    models = [ROBOT.format(index=i, x=i % side, y=i // side,
+                           allow_sleep='true' if allow_sleep else 'false')
+              for i in range(robots)]
+    handle, path = tempfile.mkstemp(suffix='.world')
+    with os.fdopen(handle, 'w') as world:
+        world.write(WORLD.format(robots=''.join(models)))
+    return path
+
+
+def run(robots, duration, allow_sleep):
+    path = write_world(robots, allow_sleep)
+    server = subprocess.Popen(['rosrun', 'gazebo', 'gzserver', path])
+    stats = subprocess.Popen(['rosrun', 'gazebo', 'gzstats'],
+                             stdout=subprocess.PIPE, universal_newlines=True)
+    try:
+        time.sleep(duration)
+    finally:
+        stats.send_signal(signal.SIGINT)
+        output = stats.communicate()[0]
+        server.send_signal(signal.SIGINT)
+        server.wait()
+        os.remove(path)
+
+    samples = STATS.findall(output)
+    if not samples:
+        raise RuntimeError('gzstats reported no statistics')
+    sim_time, real_time = (float(value) for value in samples[-1])
+    return sim_time / real_time
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split('\n')[0])
+    parser.add_argument('--robots', type=int, default=100)
+    parser.add_argument('--duration', type=float, default=30.0,
+                        help='wall seconds per run')
+    args = parser.parse_args()
+
+    awake = run(args.robots, args.duration, False)
+    asleep = run(args.robots, args.duration, True)
+    print('robots: %d' % args.robots)
+    print('sim/real without allowSleep: %.2f' % awake)
+    print('sim/real with allowSleep:    %.2f' % asleep)
+    print('speedup: %.2fx' % (asleep / awake))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,189 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <erratic_gazebo_plugins/command_log.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using gazebo::CommandCursor;
+using gazebo::CommandLog;
+
+struct TestRobot
+{
+  std::string id;
+  std::vector<CommandLog::Record> records;
+};
+
+static CommandLog::Record record(double time, double linear, double angular)
+{
+  CommandLog::Record const r = {time, linear, angular};
+  return r;
+}
+
+// Each test writes its own file, since logs are cached by path.
+static std::string write_log(std::string const &name, std::vector<TestRobot> const &robots)
+{
+  std::string const path = "/tmp/test_command_log_" + name + ".bin";
+  std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+  CommandLog::Header header;
+  memcpy(header.magic, "DDCMDLG1", sizeof(header.magic));
+  header.robot_count = robots.size();
+  header.reserved = 0;
+  file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+  boost::uint64_t first = 0;
+  for (size_t i = 0; i < robots.size(); ++i)
+  {
+    CommandLog::RobotEntry entry;
+    memset(entry.id, 0, sizeof(entry.id));
+    strncpy(entry.id, robots[i].id.c_str(), sizeof(entry.id));
+    entry.first = first;
+    entry.count = robots[i].records.size();
+    file.write(reinterpret_cast<char const *>(&entry), sizeof(entry));
+    first += entry.count;
+  }
+
+  for (size_t i = 0; i < robots.size(); ++i)
+  {
+    file.write(reinterpret_cast<char const *>(&robots[i].records[0]),
+               robots[i].records.size() * sizeof(CommandLog::Record));
+  }
+  return path;
+}
+
+static std::vector<TestRobot> one_robot(std::vector<CommandLog::Record> const &records)
+{
+  TestRobot robot;
+  robot.id = "robot_0";
+  robot.records = records;
+  return std::vector<TestRobot>(1, robot);
+}
+
+class CommandCursorTest : public testing::Test
+{
+  protected: virtual void SetUp()
+  {
+    std::vector<CommandLog::Record> records;
+    records.push_back(record(1.0, 0.5, 0.0));
+    records.push_back(record(2.0, 0.0, 0.3));
+    records.push_back(record(4.0, 0.0, 0.0));
+    path_ = write_log("cursor", one_robot(records));
+
+    log_ = CommandLog::Get(path_);
+    CommandLog::Track track;
+    ASSERT_TRUE(log_->Find("robot_0", track));
+    cursor_ = CommandCursor(track);
+  }
+
+  protected: virtual void TearDown()
+  {
+    std::remove(path_.c_str());
+  }
+
+  protected: std::string path_;
+  protected: boost::shared_ptr<CommandLog const> log_;
+  protected: CommandCursor cursor_;
+};
+
+TEST_F(CommandCursorTest, NothingBeforeTheFirstRecord)
+{
+  double linear = -1.0, angular = -1.0;
+  EXPECT_FALSE(cursor_.Get(0.0, linear, angular));
+  EXPECT_FALSE(cursor_.Get(0.999, linear, angular));
+  EXPECT_EQ(-1.0, linear);
+  EXPECT_EQ(-1.0, angular);
+}
+
+TEST_F(CommandCursorTest, HoldsEachCommandUntilTheNext)
+{
+  double linear, angular;
+  ASSERT_TRUE(cursor_.Get(1.0, linear, angular));
+  EXPECT_EQ(0.5, linear);
+  EXPECT_EQ(0.0, angular);
+
+  ASSERT_TRUE(cursor_.Get(1.5, linear, angular));
+  EXPECT_EQ(0.5, linear);
+
+  ASSERT_TRUE(cursor_.Get(3.999, linear, angular));
+  EXPECT_EQ(0.0, linear);
+  EXPECT_EQ(0.3, angular);
+
+  ASSERT_TRUE(cursor_.Get(100.0, linear, angular));
+  EXPECT_EQ(0.0, linear);
+  EXPECT_EQ(0.0, angular);
+}
+
+TEST_F(CommandCursorTest, RewindsAfterAWorldReset)
+{
+  double linear, angular;
+  ASSERT_TRUE(cursor_.Get(5.0, linear, angular));
+
+  EXPECT_FALSE(cursor_.Get(0.5, linear, angular));
+
+  ASSERT_TRUE(cursor_.Get(2.5, linear, angular));
+  EXPECT_EQ(0.0, linear);
+  EXPECT_EQ(0.3, angular);
+
+  ASSERT_TRUE(cursor_.Get(1.2, linear, angular));
+  EXPECT_EQ(0.5, linear);
+}
+
+TEST(CommandLog, RejectsUnsortedRecords)
+{
+  std::vector<CommandLog::Record> records;
+  records.push_back(record(2.0, 0.5, 0.0));
+  records.push_back(record(1.0, 0.0, 0.3));
+  std::string const path = write_log("unsorted", one_robot(records));
+
+  EXPECT_ANY_THROW(CommandLog::Get(path));
+  std::remove(path.c_str());
+}
+
+TEST(CommandLog, RejectsDuplicateRobots)
+{
+  std::vector<TestRobot> robots = one_robot(std::vector<CommandLog::Record>(1, record(1.0, 0.5, 0.0)));
+  robots.push_back(robots.front());
+  std::string const path = write_log("duplicate", robots);
+
+  EXPECT_ANY_THROW(CommandLog::Get(path));
+  std::remove(path.c_str());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+/* vim: set ts=2 sts=2 sw=2: */
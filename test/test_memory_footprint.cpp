@@ -0,0 +1,111 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <erratic_gazebo_plugins/diffdrive_plugin.h>
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include <gtest/gtest.h>
+
+// Per-robot budgets for what the plugin keeps resident, excluding the thread
+// stacks that are only reserved. An optional path log has its own budget,
+// most of which is the file buffer.
+static size_t const max_footprint = 6 * 1024;
+static size_t const max_path_logger = 12 * 1024;
+
+static size_t total(std::map<std::string, size_t> const &sizes)
+{
+  size_t sum = 0;
+  std::map<std::string, size_t>::const_iterator it;
+  for (it = sizes.begin(); it != sizes.end(); ++it)
+  {
+    sum += it->second;
+  }
+  return sum;
+}
+
+static void set_size(std::map<std::string, size_t> &footprint, std::string const &component, size_t size)
+{
+  ASSERT_TRUE(footprint.find(component) != footprint.end()) << component << " is not reported";
+  EXPECT_EQ(0u, footprint[component]) << component << " exists before Load()";
+  footprint[component] = size;
+}
+
+// Load() needs a world and a ROS master, so the components it creates are
+// added to the footprint of a constructed plugin by their sizes.
+TEST(MemoryFootprint, LoadedPluginFitsBudget)
+{
+  gazebo::DiffDrivePlugin plugin;
+  std::map<std::string, size_t> footprint = plugin.GetMemoryFootprint();
+  EXPECT_EQ(sizeof(plugin), footprint["plugin"]);
+
+  set_size(footprint, "node_handle", sizeof(ros::NodeHandle));
+  set_size(footprint, "transform_broadcaster", sizeof(tf::TransformBroadcaster));
+  set_size(footprint, "world_snapshot", sizeof(gazebo::WorldSnapshot::Entry) + sizeof(gazebo::physics::ModelPtr)
+                                        + sizeof(gazebo::WorldSnapshot));
+  set_size(footprint, "path_logger", 0);
+
+  EXPECT_LE(total(footprint), max_footprint);
+}
+
+TEST(MemoryFootprint, PathLoggerFitsBudget)
+{
+  std::string const path = "/tmp/test_memory_footprint.path";
+  {
+    // The default <pathLogTolerance> and <pathLogWindow>, on a straight run
+    // that fills the window.
+    gazebo::PathLogger logger(path, 0.01, 32);
+    for (int i = 0; i < 100; ++i)
+    {
+      gazebo::PathVertex const vertex = {0.02 * i, 0.01 * i, 0.0, 0.0};
+      logger.Log(vertex, vertex);
+    }
+    EXPECT_LE(logger.GetMemoryFootprint(), max_path_logger);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(MemoryFootprint, StacksAreReportedSeparately)
+{
+  gazebo::DiffDrivePlugin plugin;
+  std::map<std::string, size_t> const footprint = plugin.GetMemoryFootprint();
+  std::map<std::string, size_t> const reservation = plugin.GetStackReservation();
+
+  EXPECT_TRUE(footprint.find("queue_thread") == footprint.end());
+  ASSERT_TRUE(reservation.find("queue_thread") != reservation.end());
+  EXPECT_GT(reservation.find("queue_thread")->second, 0u);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+/* vim: set ts=2 sts=2 sw=2: */
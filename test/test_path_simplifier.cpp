@@ -0,0 +1,138 @@
+/*
+    Copyright (c) 2010, Daniel Hewlett, Antons Rebguns
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Neither the name of the <organization> nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY Antons Rebguns <email> ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Antons Rebguns <email> BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <erratic_gazebo_plugins/path_logger.h>
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using gazebo::PathSimplifier;
+using gazebo::PathVertex;
+
+static double const tolerance = 0.01;
+static size_t const window = 32;
+
+static PathVertex vertex(double t, double x, double y)
+{
+  PathVertex const v = {t, x, y, 0.0};
+  return v;
+}
+
+// Deterministic noise in [-amplitude, amplitude].
+static double noise(size_t i, double amplitude)
+{
+  return amplitude * std::sin(12.9898 * i + 78.233 * std::sin(4.1414 * i));
+}
+
+static double segment_distance(PathVertex const &a, PathVertex const &b, PathVertex const &p)
+{
+  double const dx = b.x - a.x;
+  double const dy = b.y - a.y;
+  double const length_sq = dx * dx + dy * dy;
+  double s = (length_sq > 0.0) ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length_sq : 0.0;
+  s = std::max(0.0, std::min(1.0, s));
+  return hypot(a.x + s * dx - p.x, a.y + s * dy - p.y);
+}
+
+static std::vector<PathVertex> simplify(std::vector<PathVertex> const &samples)
+{
+  PathSimplifier simplifier(tolerance, window);
+  std::vector<PathVertex> retained;
+  PathVertex v;
+  for (size_t i = 0; i < samples.size(); ++i)
+  {
+    if (simplifier.Add(samples[i], v)) retained.push_back(v);
+  }
+  if (simplifier.Flush(v)) retained.push_back(v);
+  return retained;
+}
+
+// Every sample lies within the tolerance of the retained segment spanning its time.
+static void expect_within_tolerance(std::vector<PathVertex> const &samples,
+                                    std::vector<PathVertex> const &retained)
+{
+  ASSERT_GE(retained.size(), 2u);
+  EXPECT_EQ(samples.front().t, retained.front().t);
+  EXPECT_EQ(samples.back().t, retained.back().t);
+
+  size_t segment = 0;
+  for (size_t i = 0; i < samples.size(); ++i)
+  {
+    while (segment + 2 < retained.size() && retained[segment + 1].t < samples[i].t) ++segment;
+    EXPECT_LE(segment_distance(retained[segment], retained[segment + 1], samples[i]), tolerance)
+      << "sample " << i << " at t = " << samples[i].t;
+  }
+}
+
+TEST(PathSimplifier, NoisyStraightLineCollapses)
+{
+  std::vector<PathVertex> samples;
+  for (size_t i = 0; i < 1000; ++i)
+  {
+    samples.push_back(vertex(0.02 * i, 0.01 * i, noise(i, 0.3 * tolerance)));
+  }
+
+  std::vector<PathVertex> const retained = simplify(samples);
+  expect_within_tolerance(samples, retained);
+
+  // Only the window limits a straight run.
+  EXPECT_LE(retained.size(), samples.size() / (window - 1) + 2);
+}
+
+TEST(PathSimplifier, KeepsTheCornerOfAnL)
+{
+  std::vector<PathVertex> samples;
+  for (size_t i = 0; i <= 100; ++i)
+  {
+    samples.push_back(vertex(0.02 * i, 0.01 * i, noise(i, 0.3 * tolerance)));
+  }
+  for (size_t i = 1; i <= 100; ++i)
+  {
+    samples.push_back(vertex(0.02 * (100 + i), 1.0 + noise(100 + i, 0.3 * tolerance), 0.01 * i));
+  }
+
+  std::vector<PathVertex> const retained = simplify(samples);
+  expect_within_tolerance(samples, retained);
+  EXPECT_LE(retained.size(), 2 * (100 / (window - 1) + 2));
+
+  double corner = HUGE_VAL;
+  for (size_t i = 0; i < retained.size(); ++i)
+  {
+    corner = std::min(corner, hypot(retained[i].x - 1.0, retained[i].y));
+  }
+  EXPECT_LE(corner, 2 * tolerance);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+/* vim: set ts=2 sts=2 sw=2: */